@@ -10,13 +10,54 @@
  * allow the sending rate to double each round (4 * ln(2) ~= 2.77) [BBRStartupPacingGain];
  * used in Startup mode for BBR.pacing_gain.
  */
-#define BBRStartupPacingGain 2.77
+#define BBRStartupPacingGain (BBR_UNIT * 277 / 100)
 
 /*
  * A constant specifying the minimum gain value that allows the sending rate to double each round (2) [BBRStartupCwndGain].
  * Used by default in most phases for BBR.cwnd_gain.
  */
-#define BBRDefaultCwndGain 2.3
+#define BBRDefaultCwndGain (BBR_UNIT * 23 / 10)
+
+/*
+ * The pacing gain used in Drain to drain the queue Startup created within one round (0.35).
+ */
+#define BBRDrainPacingGain (BBR_UNIT * 35 / 100)
+
+/*
+ * The maximum tolerated per-round-trip packet loss rate when probing for bandwidth (2%).
+ */
+#define BBRLossThresh 2
+
+/*
+ * The amount of time BBR.min_rtt remains valid without a new lower sample (10 sec).
+ */
+#define BBRMinRTTFilterLen (10 * USECS_IN_SECOND)
+
+/*
+ * Windowed max bw in Startup must grow by at least 25% per round to keep counting as growth.
+ */
+#define BBRFullBWThresh (BBR_UNIT * 5 / 4)
+#define BBRFullBWCount 3
+
+/*
+ * Startup also ends on persistent high loss: at least BBRStartupFullLossCnt (6)
+ * discontiguous lost ranges in a round spent in fast recovery.
+ */
+#define BBRStartupFullLossCnt 6
+
+/*
+ * ProbeBW pacing gains: DOWN slows to 0.9 to drain the queue a probe created,
+ * CRUISE and REFILL pace at 1.0 and UP probes at 1.25 with a cwnd gain of 2.25.
+ */
+#define BBRProbeBWDownPacingGain (BBR_UNIT * 90 / 100)
+#define BBRProbeBWUpPacingGain (BBR_UNIT * 5 / 4)
+#define BBRProbeBWUpCwndGain (BBR_UNIT * 9 / 4)
+
+/* Upper bound of the Reno coexistence probe interval, in rounds */
+#define BBRMaxRenoProbeRounds 63
+
+/* The minimal cwnd value BBR targets, 4 packets */
+#define BBRMinPipeCwnd(C) (4 * (C)->smss)
 
 /*
  * The static discount factor of 1% used to scale BBR.bw to produce BBR.pacing_rate.
@@ -26,11 +67,23 @@
 #define BBRPacingMarginPercent 1
 
 
-/* Get time */
+static struct cc_algo bbr_cc_algo;
+
+/* Get monotonic time in usec, the unit of every BBR timestamp */
 static uint64_t
 Now()
 {
-    return (int long)time(NULL);
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * USECS_IN_SECOND + ts.tv_nsec / 1000);
+}
+
+/* Clamp a 64 bit volume or rate to 32 bits, the helper.h min()/max() take unsigned int */
+static uint32_t
+BBRClamp32(uint64_t v)
+{
+    return (v > UINT_MAX ? UINT_MAX : v);
 }
 
 /* Check if new measurement updates the 1st, 2nd or 3rd choice max. */
@@ -43,7 +96,9 @@ UpdateWindowedMaxFilter(struct MaxBwFilter *m, uint32_t win, uint32_t value, uin
         return minmax_reset(m, time, value); /* forget earlier samples */
 
     if (val.v >= m->s[1].v)
-        m->s[1] = val;
+        m->s[2] = m->s[1] = val;
+    else if (val.v >= m->s[2].v)
+        m->s[2] = val;
 
     return minmax_subwin_update(m, win, &val);
 }
@@ -61,6 +116,9 @@ BBRResetCongestionSignals(struct tcp_bbr *BBR)
     BBR->loss_in_round = 0;
     BBR->bw_latest = 0;
     BBR->inflight_latest = 0;
+    BBR->round_lost = 0;
+    BBR->round_loss_events = 0;
+    BBR->round_delivered_start = BBR->C->delivered;
 }
 
 /*
@@ -102,8 +160,9 @@ BBRInitPacingRate(struct tcp_bbr *BBR)
 {
     uint32_t InitialCwnd = initial_window(BBR->C);
 
-    uint32_t nominal_bandwidth = InitialCwnd / (BBR->C->SRTT ? BBR->C->SRTT : 1); /* 1 is for 1 ms */
-    BBR->pacing_rate =  BBRStartupPacingGain * nominal_bandwidth;
+    /* bytes per second, 1000 is for 1 ms when there is no RTT sample yet */
+    uint64_t nominal_bandwidth = (uint64_t)InitialCwnd * USECS_IN_SECOND / (BBR->C->SRTT ? BBR->C->SRTT : 1000);
+    BBR->pacing_rate = BBRClamp32((BBRStartupPacingGain * nominal_bandwidth) >> BBR_SCALE);
 }
 
 /*
@@ -121,27 +180,34 @@ BBREnterStartup(struct tcp_bbr *BBR)
 /*
  * bbr_init on FreeBSD/Linux implementation.
  * Upon transport connection initialization,
- * BBR executes its initialization steps
+ * BBR executes its initialization steps.
+ * BBR->C must already point at the connection's tcp_cb (see conn_alloc()).
  */
-static void BBROnInit(struct tcp_cb *C) {
-    struct tcp_bbr BBR = {.C = C, .MaxBwFilter = {0}};
-
-    InitWindowedMaxFilter(&BBR.MaxBwFilter, 0, .0);
-    BBR.min_rtt = C->SRTT ? C->SRTT : 1;
-    BBR.min_rtt_stamp = Now();
-    BBR.probe_rtt_done_stamp = 0;
-    BBR.probe_rtt_round_done = false;
-    BBR.prior_cwnd = 0;
-    BBR.idle_restart = false;
-    BBR.extra_acked_interval_start = Now();
-    BBR.extra_acked_delivered = 0;
-    BBR.full_bw_reached = false;
-    BBRResetCongestionSignals(&BBR);
-    BBRResetLowerBounds(&BBR);
-    BBRInitRoundCounting(&BBR);
-    BBRResetFullBW(&BBR);
-    BBRInitPacingRate(&BBR);
-    BBREnterStartup(&BBR);
+void
+BBROnInit(struct tcp_bbr *BBR)
+{
+    struct tcp_cb *C = BBR->C;
+
+    C->cc_algo = &bbr_cc_algo;
+    C->cc_data = BBR;
+    InitWindowedMaxFilter(&BBR->MaxBwFilter, 0, .0);
+    BBR->min_rtt = C->SRTT ? C->SRTT : Infinity;
+    BBR->min_rtt_stamp = Now();
+    BBR->probe_rtt_done_stamp = 0;
+    BBR->probe_rtt_round_done = false;
+    BBR->prior_cwnd = 0;
+    BBR->packet_conservation = false;
+    BBR->recovery_round = 0;
+    BBR->idle_restart = false;
+    BBR->extra_acked_interval_start = Now();
+    BBR->extra_acked_delivered = 0;
+    BBR->full_bw_reached = false;
+    BBRResetCongestionSignals(BBR);
+    BBRResetLowerBounds(BBR);
+    BBRInitRoundCounting(BBR);
+    BBRResetFullBW(BBR);
+    BBRInitPacingRate(BBR);
+    BBREnterStartup(BBR);
 };
 
 /*
@@ -158,36 +224,84 @@ static void BBROnInit(struct tcp_cb *C) {
 static void
 BBRCheckStartupHighLoss(struct tcp_bbr *BBR)
 {
+    struct tcp_cb *C = BBR->C;
+    uint64_t round_delivered = C->delivered - BBR->round_delivered_start;
+
+    /* Called at the end of each round, with the counters of the round that just ended */
+    if (BBR->state != STARTUP || BBR->full_bw_reached)
+        return;
+    if (!IN_FASTRECOVERY(C->flags) || BBR->round_count == BBR->recovery_round)
+        return;
+    if ((uint64_t)BBR->round_lost * 100 <= (BBR->round_lost + round_delivered) * BBRLossThresh)
+        return;
+    if (BBR->round_loss_events < BBRStartupFullLossCnt)
+        return;
     BBR->full_bw_reached = true;
-    BBR->inflight_hi = max(BBR->bdp, BBR->inflight_latest);
+    BBR->inflight_hi = max(BBRClamp32(BBR->bdp), BBR->inflight_latest);
+}
+
+/*
+ * Once per round, BBR checks whether BBR.max_bw grew by at least BBRFullBWThresh (25%).
+ * After BBRFullBWCount (3) non-app-limited rounds without such growth BBR.full_bw_now is set.
+ * Used in Startup to estimate the pipe is full and in ProbeBW_UP to stop probing.
+ */
+static void
+BBRCheckFullBWReached(struct tcp_bbr *BBR, const struct bbr_rate_sample *rs)
+{
+    if (BBR->full_bw_now || !BBR->round_start || rs->is_app_limited)
+        return;
+    if ((uint64_t)BBR->max_bw * BBR_UNIT >= (uint64_t)BBR->full_bw * BBRFullBWThresh) {
+        BBR->full_bw = BBR->max_bw;
+        BBR->full_bw_count = 0;
+        return;
+    }
+    BBR->full_bw_count++;
+    BBR->full_bw_now = BBR->full_bw_count >= BBRFullBWCount;
 }
 
 static void
-BBREnterDrain()
+BBRCheckStartupFullBandwidth(struct tcp_bbr *BBR, const struct bbr_rate_sample *rs)
 {
+    if (BBR->full_bw_reached)
+        return;
+    BBRCheckFullBWReached(BBR, rs);
+    if (BBR->full_bw_now)
+        BBR->full_bw_reached = true;
+}
 
+static void
+BBREnterDrain(struct tcp_bbr *BBR)
+{
+    BBR->state = DRAIN;
+    BBR->pacing_gain = BBRDrainPacingGain;
+    BBR->cwnd_gain = BBRDefaultCwndGain;
 }
 
 static void
-BBRCheckStartupDone(struct tcp_bbr *BBR)
+BBRCheckStartupDone(struct tcp_bbr *BBR, const struct bbr_rate_sample *rs)
 {
-    BBRCheckStartupHighLoss(BBR);
+    BBRCheckStartupFullBandwidth(BBR, rs);
     if (BBR->state == STARTUP && BBR->full_bw_reached)
-        BBREnterDrain();
+        BBREnterDrain(BBR);
 };
 
-static void BBRUpdateRound(struct tcp_bbr *BBR) {
-
+/* A packet-timed round ends when a packet sent after the previous round end is acked */
+static void
+BBRUpdateRound(struct tcp_bbr *BBR, const struct bbr_rate_sample *rs)
+{
+    if (rs->prior_delivered >= BBR->next_round_delivered) {
+        BBR->next_round_delivered = BBR->C->delivered;
+        BBR->round_count++;
+        BBR->rounds_since_bw_probe++;
+        BBR->round_start = true;
+    } else
+        BBR->round_start = false;
 }
 
 static uint8_t
 IsInAProbeBWState(struct tcp_bbr *BBR)
 {
-    uint8_t state = BBR->state;
-    return (state == PROBE_BW_DOWN ||
-            state == PROBE_BW_CRUISE ||
-            state == PROBE_BW_REFILL ||
-            state == PROBE_BW_UP);
+    return (BBR->state == PROBE_BW);
 };
 
 
@@ -202,7 +316,7 @@ IsInAProbeBWState(struct tcp_bbr *BBR)
 static void
 BBRSetPacingRateWithGain(struct tcp_bbr *BBR, uint32_t pacing_gain)
 {
-    uint32_t rate = pacing_gain * BBR->bw * (100 - BBRPacingMarginPercent) / 100;
+    uint32_t rate = BBRClamp32((((uint64_t)pacing_gain * BBR->bw) >> BBR_SCALE) * (100 - BBRPacingMarginPercent) / 100);
     if (BBR->full_bw_reached || rate > BBR->pacing_rate)
       BBR->pacing_rate = rate;
 };
@@ -214,7 +328,7 @@ BBRSetPacingRateWithGain(struct tcp_bbr *BBR, uint32_t pacing_gain)
 static void
 BBRSaveCwnd(struct tcp_bbr *BBR)
 {
-    if (!InLossRecovery() && BBR->state != PROBE_RTT)
+    if (!InLossRecovery(BBR->C) && BBR->state != PROBE_RTT)
       BBR->prior_cwnd = BBR->C->cwnd;
     else
       BBR->prior_cwnd = max(BBR->prior_cwnd, BBR->C->cwnd);
@@ -257,8 +371,11 @@ BBRRaiseInflightHiSlope(struct tcp_bbr *BBR)
 static void
 BBRStartProbeBW_DOWN(struct tcp_bbr *BBR)
 {
+    BBR->state = PROBE_BW;
+    BBR->pacing_gain = BBRProbeBWDownPacingGain;
+    BBR->cwnd_gain = BBRDefaultCwndGain;
     BBRResetCongestionSignals(BBR);
-    BBR->probe_up_cnt = Infinity /* not growing inflight_hi */
+    BBR->probe_up_cnt = Infinity; /* not growing inflight_hi */
     BBRPickProbeWait(BBR);
     BBR->cycle_stamp = Now();  /* start wall clock */
     BBR->ack_phase  = ACKS_PROBE_STOPPING;
@@ -269,6 +386,7 @@ BBRStartProbeBW_DOWN(struct tcp_bbr *BBR)
 static void
 BBRStartProbeBW_CRUISE(struct tcp_bbr *BBR)
 {
+    BBR->pacing_gain = BBR_UNIT;
     BBR->sub_state = PROBE_BW_CRUISE;
 };
 
@@ -280,6 +398,7 @@ BBRStartProbeBW_REFILL(struct tcp_bbr *BBR)
     BBR->bw_probe_up_acks = 0;
     BBR->ack_phase = ACKS_REFILLING;
     BBRStartRound(BBR);
+    BBR->pacing_gain = BBR_UNIT;
     BBR->sub_state = PROBE_BW_REFILL;
 };
 
@@ -289,8 +408,10 @@ BBRStartProbeBW_UP(struct tcp_bbr *BBR)
     BBR->ack_phase = ACKS_PROBE_STARTING;
     BBRStartRound(BBR);
     BBRResetFullBW(BBR);
-    BBR->full_bw = rs.delivery_rate; /* incomplete */
-    BBR->state = PROBE_BW_UP;
+    BBR->full_bw = BBR->bw_latest; /* latest rs.delivery_rate */
+    BBR->pacing_gain = BBRProbeBWUpPacingGain;
+    BBR->cwnd_gain = BBRProbeBWUpCwndGain;
+    BBR->sub_state = PROBE_BW_UP;
     BBRRaiseInflightHiSlope(BBR);
 };
 
@@ -335,7 +456,7 @@ static void BBRHandleRestartFromIdle(struct tcp_bbr *BBR) {
         BBR->idle_restart = true;
         BBR->extra_acked_interval_start = Now();
         if (IsInAProbeBWState(BBR))
-            BBRSetPacingRateWithGain(BBR, 1);
+            BBRSetPacingRateWithGain(BBR, BBR_UNIT);
         else if (BBR->state == PROBE_RTT)
             BBRCheckProbeRTTDone(BBR);
     }
@@ -346,8 +467,229 @@ static void BBRHandleRestartFromIdle(struct tcp_bbr *BBR) {
  *
  When transmitting, BBR merely needs to check for the case where the flow is restarting from idle.
  */
-static void
+void
 BBROnTransmit(struct tcp_bbr *BBR)
 {
     BBRHandleRestartFromIdle(BBR);
-}
\ No newline at end of file
+}
+
+/* rs.delivery_rate clamped to the 32 bit bw fields */
+static uint32_t
+BBRRateSampleBw(const struct bbr_rate_sample *rs)
+{
+    return (BBRClamp32(rs->delivery_rate));
+}
+
+/* BBR.max_bw is the windowed max of non-app-limited delivery rate samples, over bbr_bw_rtts rounds */
+static void
+BBRUpdateMaxBw(struct tcp_bbr *BBR, const struct bbr_rate_sample *rs)
+{
+    if (rs->delivery_rate >= BBR->max_bw || !rs->is_app_limited)
+        BBR->max_bw = UpdateWindowedMaxFilter(&BBR->MaxBwFilter, bbr_bw_rtts,
+                                              BBRRateSampleBw(rs), BBR->round_count);
+}
+
+/* 1-round-trip maxima of delivery rate and delivered volume */
+static void
+BBRUpdateLatestDeliverySignals(struct tcp_bbr *BBR, const struct bbr_rate_sample *rs)
+{
+    if (rs->lost)
+        BBR->loss_in_round = true;
+    BBR->round_lost += rs->newly_lost;
+    BBR->round_loss_events += rs->newly_lost_ranges;
+    BBR->bw_latest = max(BBR->bw_latest, BBRRateSampleBw(rs));
+    BBR->inflight_latest = max(BBR->inflight_latest, rs->delivered);
+}
+
+static void
+BBRUpdateMinRTT(struct tcp_bbr *BBR, const struct bbr_rate_sample *rs)
+{
+    uint64_t now = Now();
+
+    if (rs->rtt == 0)
+        return;
+    if (rs->rtt < BBR->min_rtt || now > BBR->min_rtt_stamp + BBRMinRTTFilterLen) {
+        BBR->min_rtt = rs->rtt;
+        BBR->min_rtt_stamp = now;
+    }
+}
+
+/* Drain is done once inflight has fallen to the estimated BDP, then BBR cruises in ProbeBW */
+static void
+BBRCheckDrainDone(struct tcp_bbr *BBR)
+{
+    if (BBR->state == DRAIN && BBR->C->pipe <= BBR->bdp) {
+        BBRStartProbeBW_DOWN(BBR);
+        BBRStartProbeBW_CRUISE(BBR);
+    }
+}
+
+/*
+ * Probe at least as often as a Reno flow sharing the path would fill the
+ * queue: once per BDP-in-packets rounds, at most BBRMaxRenoProbeRounds.
+ */
+static uint8_t
+BBRIsRenoCoexistenceProbeTime(struct tcp_bbr *BBR)
+{
+    uint32_t reno_rounds = min(BBRClamp32(BBR->bdp) / BBR->C->smss, BBRMaxRenoProbeRounds);
+
+    return (BBR->rounds_since_bw_probe >= reno_rounds);
+}
+
+/* Time to leave DOWN or CRUISE and refill the pipe before probing UP */
+static uint8_t
+BBRCheckTimeToProbeBW(struct tcp_bbr *BBR)
+{
+    if (Now() > BBR->cycle_stamp + BBR->bw_probe_wait || BBRIsRenoCoexistenceProbeTime(BBR)) {
+        BBRStartProbeBW_REFILL(BBR);
+        return (true);
+    }
+    return (false);
+}
+
+/* A probe drove inflight beyond what the path holds without excessive loss */
+static uint8_t
+BBRIsInflightTooHigh(const struct bbr_rate_sample *rs)
+{
+    return ((uint64_t)rs->lost * 100 > (uint64_t)rs->tx_in_flight * BBRLossThresh);
+}
+
+/*
+ * ProbeBW gain cycling: DOWN drains the queue of the last probe until inflight
+ * is back at the BDP, CRUISE holds the rate until it is time to probe, REFILL
+ * spends one round at gain 1.0 to fill the pipe, UP probes at 1.25 until
+ * max_bw stops growing or loss shows inflight is too high.
+ */
+static void
+BBRUpdateProbeBWCyclePhase(struct tcp_bbr *BBR, const struct bbr_rate_sample *rs)
+{
+    if (!BBR->full_bw_reached || !IsInAProbeBWState(BBR))
+        return;
+    switch (BBR->sub_state) {
+    case PROBE_BW_DOWN:
+        if (BBRCheckTimeToProbeBW(BBR))
+            return;
+        if (BBR->C->pipe <= BBR->bdp)
+            BBRStartProbeBW_CRUISE(BBR);
+        break;
+    case PROBE_BW_CRUISE:
+        BBRCheckTimeToProbeBW(BBR);
+        break;
+    case PROBE_BW_REFILL:
+        if (BBR->round_start)
+            BBRStartProbeBW_UP(BBR);
+        break;
+    case PROBE_BW_UP:
+        BBRCheckFullBWReached(BBR, rs);
+        if (BBR->full_bw_now || BBRIsInflightTooHigh(rs))
+            BBRStartProbeBW_DOWN(BBR);
+        break;
+    }
+}
+
+/*
+ * Packet conservation: during the first round of fast recovery cwnd starts from
+ * the data still in flight and each ACK lets out only as much as it delivered.
+ */
+static void
+BBRModulateCwndForRecovery(struct tcp_bbr *BBR, const struct bbr_rate_sample *rs)
+{
+    struct tcp_cb *C = BBR->C;
+
+    if (BBR->packet_conservation)
+        C->cwnd = max(C->cwnd, C->pipe + rs->newly_acked);
+}
+
+/*
+ * cwnd tracks cwnd_gain * BDP, growing by at most the newly acked volume per ACK
+ * until the pipe is full, and never drops below 4 packets.
+ * During the packet conservation round cwnd is left to it; afterwards cwnd
+ * follows the model again, also in fast recovery, as Linux BBR does.
+ */
+static void
+BBRSetCwnd(struct tcp_bbr *BBR, const struct bbr_rate_sample *rs)
+{
+    struct tcp_cb *C = BBR->C;
+    uint32_t max_inflight = max(BBRClamp32((BBR->bdp * BBR->cwnd_gain) >> BBR_SCALE), BBRMinPipeCwnd(C));
+
+    BBRModulateCwndForRecovery(BBR, rs);
+    if (BBR->packet_conservation)
+        return;
+    if (BBR->full_bw_reached)
+        C->cwnd = min(C->cwnd + rs->newly_acked, max_inflight);
+    else if (C->cwnd < max_inflight || C->delivered < (uint32_t)initial_window(C))
+        C->cwnd += rs->newly_acked;
+    C->cwnd = max(C->cwnd, BBRMinPipeCwnd(C));
+}
+
+/*
+ * Per-ACK Steps
+ *
+ * On every ACK BBR updates its model of the path from the rate sample,
+ * advances its state machine and derives the pacing rate and cwnd from the model.
+ */
+void
+BBROnACK(struct tcp_bbr *BBR, const struct bbr_rate_sample *rs)
+{
+    BBRUpdateRound(BBR, rs);
+    if (BBR->round_start) {
+        BBRCheckStartupHighLoss(BBR);
+        BBRResetCongestionSignals(BBR);
+        BBR->packet_conservation = false;
+    }
+    BBRUpdateLatestDeliverySignals(BBR, rs);
+    BBRUpdateMaxBw(BBR, rs);
+    BBRUpdateMinRTT(BBR, rs);
+    BBR->bw = min(BBR->max_bw, BBR->bw_lo);
+    BBR->bdp = (uint64_t)BBR->bw * BBR->min_rtt / USECS_IN_SECOND;
+    BBRCheckStartupDone(BBR, rs);
+    BBRCheckDrainDone(BBR);
+    BBRUpdateProbeBWCyclePhase(BBR, rs);
+    BBRSetPacingRateWithGain(BBR, BBR->pacing_gain);
+    BBRSetCwnd(BBR, rs);
+}
+
+/*
+ * Loss recovery hooks, called from cc_cong_signal() and cc_ack_received().
+ *
+ * BBR does not use PRR or ssthresh (CC_ALGO_NOPRR), it uses plain packet
+ * conservation as Linux BBR does.
+ * Entering fast recovery: remember the last good cwnd, cut cwnd to pipe and
+ * conserve packets for one round, BBRModulateCwndForRecovery() adds what this ACK delivered.
+ * On RTO: remember the last good cwnd and send one packet beyond pipe.
+ */
+static void
+BBRCongSignal(struct tcp_cb *C, uint32_t type)
+{
+    struct tcp_bbr *BBR = C->cc_data;
+
+    BBRSaveCwnd(BBR);
+    switch (type) {
+    case CC_NDUPACK:
+        C->cwnd = C->pipe;
+        BBR->packet_conservation = true;
+        BBR->recovery_round = BBR->round_count;
+        BBRStartRound(BBR);
+        break;
+    case CC_RTO:
+        C->cwnd = C->pipe + C->smss;
+        BBR->packet_conservation = false;
+        break;
+    }
+}
+
+/* Leaving recovery: back to the cwnd BBR had before the loss */
+static void
+BBRPostRecovery(struct tcp_cb *C)
+{
+    struct tcp_bbr *BBR = C->cc_data;
+
+    BBR->packet_conservation = false;
+    BBRRestoreCwnd(BBR);
+}
+
+static struct cc_algo bbr_cc_algo = {
+    .cong_signal = BBRCongSignal,
+    .post_recovery = BBRPostRecovery,
+    .flags = CC_ALGO_NOPRR,
+};
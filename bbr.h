@@ -1,12 +1,19 @@
+#ifndef _BBR_H_
+#define _BBR_H_
+
 #include <stdint.h>
 #include <limits.h>
 #include <sys/types.h>
 #include "cc.h"
 
-#define Infinity    UINT_MAX;
+#define Infinity    UINT_MAX
 
 #define CYCLE_LEN	8	/* number of phases in a pacing gain cycle */
 
+/* Gains are fixed point with BBR_SCALE fractional bits, BBR_UNIT is a gain of 1.0 */
+#define BBR_SCALE	8
+#define BBR_UNIT	(1 << BBR_SCALE)
+
 /* Window length of bw filter (in rounds): */
 static const int bbr_bw_rtts = CYCLE_LEN + 2;
 
@@ -41,7 +48,25 @@ struct minmax_sample {
 };
 
 struct MaxBwFilter {
-    struct minmax_sample s[2];
+    struct minmax_sample s[3];
+};
+
+/*
+ * Per-ACK rate sample, filled in by the transport's delivery rate estimator.
+ * Rates are in bytes per second, volumes in bytes, times in usec.
+ */
+struct bbr_rate_sample {
+    uint64_t delivery_rate; /* delivered / interval */
+    uint32_t delivered; /* volume delivered over the sample interval */
+    uint32_t prior_delivered; /* C->delivered when the most recently acked packet was sent */
+    uint32_t newly_acked; /* volume cumulatively acked or SACKed by this ACK */
+    uint32_t lost; /* volume marked lost over the sample interval */
+    uint32_t newly_lost; /* volume marked lost by this ACK */
+    uint32_t newly_lost_ranges; /* discontiguous sequence ranges in newly_lost */
+    uint32_t tx_in_flight; /* inflight when the most recently acked packet was sent */
+    uint32_t rtt; /* RTT of the most recently acked packet, 0 if none */
+    uint8_t is_app_limited:1,
+            unused:7;
 };
 
 struct tcp_bbr {
@@ -76,6 +101,11 @@ struct tcp_bbr {
     uint32_t full_bw; /* A recent baseline BBR.max_bw to estimate if BBR has "filled the pipe" in Startup. */
     uint32_t full_bw_count; /* The number of non-app-limited round trips without large increases in BBR.full_bw. */
 
+    uint32_t round_lost; /* volume marked lost in the current round */
+    uint32_t round_loss_events; /* discontiguous ranges marked lost in the current round */
+    uint32_t round_delivered_start; /* C->delivered at the start of the current round */
+    uint32_t recovery_round; /* round_count when fast recovery was last entered */
+
     uint32_t pacing_rate; /* The current pacing rate for a BBR flow, which controls inter-packet spacing. */
 
     uint32_t pacing_gain; /* The dynamic gain factor used to scale BBR.bw to produce BBR.pacing_rate. */
@@ -105,7 +135,8 @@ struct tcp_bbr {
             state:2, /* bbr_mode */
             sub_state:2, /* bbr sub state of Probe_BW */
             ack_phase:2, /* bbr ack phases */
-            unused:4;
+            packet_conservation:1, /* first round of fast recovery, cwnd at least pipe + newly acked */
+            unused:3;
 };
 
 static inline uint32_t
@@ -113,12 +144,12 @@ minmax_reset(struct MaxBwFilter *m, uint32_t time, uint32_t value)
 {
 	struct minmax_sample val = { .t = time, .v = value };
 
-	m->s[1] = m->s[0] = val;
+	m->s[2] = m->s[1] = m->s[0] = val;
 	return m->s[0].v;
 }
 
 /* As time advances, update the 1st and 2nd choices. */
-static uint32_t
+static inline uint32_t
 minmax_subwin_update(struct MaxBwFilter *m, uint32_t win, const struct minmax_sample *val)
 {
     uint32_t dt = val->t - m->s[0].t;
@@ -131,17 +162,31 @@ minmax_subwin_update(struct MaxBwFilter *m, uint32_t win, const struct minmax_sa
 		 * may also be outside the window.
 		 */
 		m->s[0] = m->s[1];
-		m->s[1] = *val;
+		m->s[1] = m->s[2];
+		m->s[2] = *val;
 		if (val->t - m->s[0].t > win) {
 			m->s[0] = m->s[1];
-			m->s[1] = *val;
+			m->s[1] = m->s[2];
+			m->s[2] = *val;
 		}
 	} else if (m->s[1].t == m->s[0].t && dt > win/4) {
 		/*
 		 * We've passed a quarter of the window without a new val
 		 * so take a 2nd choice from the 2nd quarter of the window.
 		 */
-		m->s[1] = *val;
+		m->s[2] = m->s[1] = *val;
+	} else if (m->s[2].t == m->s[1].t && dt > win/2) {
+		/*
+		 * We've passed half the window without finding a new val
+		 * so take a 3rd choice from the last half of the window
+		 */
+		m->s[2] = *val;
     }
 	return m->s[0].v;
-}
\ No newline at end of file
+}
+
+extern void BBROnInit(struct tcp_bbr *BBR);
+extern void BBROnTransmit(struct tcp_bbr *BBR);
+extern void BBROnACK(struct tcp_bbr *BBR, const struct bbr_rate_sample *rs);
+
+#endif /* _BBR_H_ */
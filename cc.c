@@ -30,9 +30,8 @@ initial_sshthresh(struct tcp_cb *cb)
 };
 
 static void
-cc_ack_recv(struct tcp_cb *cb)
+cc_ack_recv(struct tcp_cb *cb, uint32_t this_bytes_ack)
 {
-    uint32_t this_bytes_ack = cb->snd_una - cb->bytes_acked;
     if (cb->cwnd > cb->ssthresh)
         /*  If the above formula yields 0, the result SHOULD be rounded up to 1 byte. */
         cb->cwnd += max(cb->smss*cb->smss/cb->cwnd, 1); 
@@ -47,12 +46,12 @@ tcp_compute_pipe(struct tcp_cb *cb) {
 }
 
 /* 
- * tcp_compute_pipe(cb) * cb->cwnd should be flight size.
+ * Per RFC5681 Section 3.1, ssthresh = max(FlightSize / 2, 2*SMSS).
  * FlightSize is the amount of outstanding data in the network.
  */
 static void
-cc_cong_signal(struct tcp_cb *cb) {
-    cb->ssthresh = max((tcp_compute_pipe(cb) * cb->cwnd) / 2, 2*cb->smss);
+newreno_ssthresh(struct tcp_cb *cb) {
+    cb->ssthresh = max(tcp_compute_pipe(cb) / 2, 2*cb->smss);
 }
 
 uint32_t
@@ -78,9 +77,124 @@ ctf_flight_size(struct tcp_cb *tp, uint32_t rc_sacked)
 	}
 }
 
-/* dummy function */
+/* Fast recovery or RTO recovery */
 uint8_t
-InLossRecovery()
+InLossRecovery(struct tcp_cb *cb)
 {
-    return true;
+    return (IN_RECOVERY(cb->flags) != 0);
+}
+
+static void
+cc_post_recovery(struct tcp_cb *cb)
+{
+    uint8_t was_fast = IN_FASTRECOVERY(cb->flags) != 0;
+
+    EXIT_RECOVERY(cb->flags);
+    if (cb->cc_algo != NULL && cb->cc_algo->post_recovery != NULL)
+        cb->cc_algo->post_recovery(cb);
+    else if (was_fast)
+        cb->cwnd = max(cb->ssthresh, cb->smss); /* Per RFC6937 Section 3.1 */
+}
+
+/*
+ * A congestion signal from loss detection.
+ * CC_NDUPACK enters fast recovery once per window of data (RFC 6582 "recover"),
+ * CC_RTO collapses cwnd to one segment and stays in congestion recovery until
+ * everything outstanding at the timeout has been acked.
+ */
+void
+cc_cong_signal(struct tcp_cb *cb, uint32_t type)
+{
+    switch (type) {
+    case CC_NDUPACK:
+        /* An ACK that completes the episode and reports new loss closes it first, whatever the caller's order */
+        if (IN_RECOVERY(cb->flags) && SEQ_GEQ(cb->snd_una, cb->recover))
+            cc_post_recovery(cb);
+        if (IN_FASTRECOVERY(cb->flags) || SEQ_LT(cb->snd_una, cb->recover))
+            return;
+        cb->recover = cb->snd_max;
+        cb->recover_fs = max(tcp_compute_pipe(cb), 1);
+        cb->prr_delivered = 0;
+        cb->prr_out = 0;
+        if (cb->cc_algo != NULL && cb->cc_algo->cong_signal != NULL)
+            cb->cc_algo->cong_signal(cb, type);
+        else
+            newreno_ssthresh(cb);
+        ENTER_RECOVERY(cb->flags);
+        break;
+    case CC_RTO:
+        if (cb->rxtshift < UINT8_MAX)
+            cb->rxtshift++;
+        cb->recover = cb->snd_max;
+        if (cb->cc_algo != NULL && cb->cc_algo->cong_signal != NULL)
+            cb->cc_algo->cong_signal(cb, type);
+        else {
+            /* Per RFC5681 Section 3.1, ssthresh only shrinks on the first timeout of a loss episode */
+            if (cb->rxtshift == 1)
+                newreno_ssthresh(cb);
+            cb->cwnd = cb->smss;
+        }
+        EXIT_FASTRECOVERY(cb->flags);
+        ENTER_CONGRECOVERY(cb->flags);
+        break;
+    }
+}
+
+/*
+ * Proportional Rate Reduction, RFC 6937 Section 3.1.
+ * While pipe is above ssthresh, sending is spread proportionally over the
+ * recovery so that cwnd reaches ssthresh by the end of it; once pipe falls
+ * below ssthresh the slow start reduction bound (PRR-SSRB) rebuilds it
+ * without bursting.
+ */
+static void
+tcp_prr_update(struct tcp_cb *cb, uint32_t delivered_data)
+{
+    int64_t sndcnt, limit;
+
+    cb->prr_delivered += delivered_data;
+    if (cb->pipe > cb->ssthresh) {
+        sndcnt = ((uint64_t)cb->prr_delivered * cb->ssthresh + cb->recover_fs - 1) / cb->recover_fs;
+        sndcnt -= cb->prr_out;
+    } else {
+        limit = (int64_t)cb->prr_delivered - cb->prr_out;
+        if (limit < delivered_data)
+            limit = delivered_data;
+        limit += cb->smss;
+        sndcnt = (int64_t)cb->ssthresh - cb->pipe;
+        if (sndcnt > limit)
+            sndcnt = limit;
+    }
+    if (sndcnt < 0)
+        sndcnt = 0;
+    cb->cwnd = cb->pipe + sndcnt;
+}
+
+/*
+ * Per-ACK loss recovery step, called once snd_una and pipe reflect the ACK.
+ * acked is the data newly acked cumulatively, sacked the data newly SACKed.
+ */
+void
+cc_ack_received(struct tcp_cb *cb, uint32_t acked, uint32_t sacked)
+{
+    if (acked)
+        cb->rxtshift = 0;
+    if (IN_RECOVERY(cb->flags) && SEQ_GEQ(cb->snd_una, cb->recover)) {
+        cc_post_recovery(cb);
+        return;
+    }
+    if (IN_FASTRECOVERY(cb->flags)) {
+        if (cb->cc_algo == NULL || !(cb->cc_algo->flags & CC_ALGO_NOPRR))
+            tcp_prr_update(cb, acked + sacked);
+    }
+    else if (cb->cc_algo == NULL && acked)
+        cc_ack_recv(cb, acked);
+}
+
+/* Account data sent during fast recovery, RFC 6937 prr_out */
+void
+cc_on_transmit(struct tcp_cb *cb, uint32_t bytes)
+{
+    if (IN_FASTRECOVERY(cb->flags))
+        cb->prr_out += bytes;
 }
\ No newline at end of file
@@ -1,3 +1,6 @@
+#ifndef _CC_H_
+#define _CC_H_
+
 #include <stdint.h>
 
 #define	TCP_NSTATES	11
@@ -81,6 +84,33 @@
 
 #define	BYTES_THIS_ACK(tp, th)	(th->th_ack - tp->snd_una)
 
+#define	SEQ_LT(a,b)	((int)((a)-(b)) < 0)
+#define	SEQ_LEQ(a,b)	((int)((a)-(b)) <= 0)
+#define	SEQ_GT(a,b)	((int)((a)-(b)) > 0)
+#define	SEQ_GEQ(a,b)	((int)((a)-(b)) >= 0)
+
+/*
+ * Congestion signal types passed to cc_cong_signal().
+ */
+#define	CC_NDUPACK	0x01	/* loss detected by duplicate ACKs or SACK */
+#define	CC_RTO		0x02	/* retransmission timeout */
+
+#define	CC_ALGO_NOPRR	0x01	/* the algorithm sets cwnd in fast recovery itself, PRR stays out */
+
+struct tcp_cb;
+
+/*
+ * Congestion control algorithm hooks into loss recovery.
+ * Without an algorithm (cc_algo == NULL) NewReno behaviour applies.
+ */
+struct cc_algo {
+    /* Entering fast recovery or RTO: set ssthresh and/or cwnd. Called before the recovery flags change. */
+    void (*cong_signal)(struct tcp_cb *cb, uint32_t type);
+    /* Leaving recovery: restore cwnd. Called after the recovery flags are cleared. */
+    void (*post_recovery)(struct tcp_cb *cb);
+    uint32_t flags; /* CC_ALGO_* */
+};
+
 
 struct tcp_cb {
     uint32_t cwnd;
@@ -96,11 +126,23 @@ struct tcp_cb {
     uint32_t pipe; /* The sender's estimate of the amount of data outstanding in the network (measured in octets or packets).
                     * This includes data packets in the current outstanding window that are being transmitted or retransmitted and have not been SACKed or marked lost (e.g. "pipe" from [RFC6675]).
                     * This does not include pure ACK packets. */
+    uint32_t recover; /* snd_max when recovery started, recovery ends once snd_una reaches it */
+    uint32_t recover_fs; /* RecoverFS, flight size when recovery started (RFC 6937) */
+    uint32_t prr_delivered; /* data delivered to the receiver since recovery started (RFC 6937) */
+    uint32_t prr_out; /* data sent since recovery started (RFC 6937) */
+    struct cc_algo *cc_algo; /* congestion control hooks, NULL for NewReno */
+    void *cc_data; /* congestion control private state */
     uint16_t nsegs;
+    uint8_t rxtshift; /* number of consecutive RTOs */
     uint8_t app_limited:1,
             state:4, /* tcp states */
             unused:3;
 };
 
 extern int initial_window(struct tcp_cb *cb);
-extern uint8_t InLossRecovery();
\ No newline at end of file
+extern uint8_t InLossRecovery(struct tcp_cb *cb);
+extern void cc_cong_signal(struct tcp_cb *cb, uint32_t type);
+extern void cc_ack_received(struct tcp_cb *cb, uint32_t acked, uint32_t sacked);
+extern void cc_on_transmit(struct tcp_cb *cb, uint32_t bytes);
+
+#endif /* _CC_H_ */
@@ -0,0 +1,118 @@
+#include <stdlib.h>
+#include "conn.h"
+
+/*
+ * Reset the slot for a new connection.
+ * The tcp_cb is small, so it is rebuilt with a single assignment.
+ * Of tcp_bbr only the fields BBROnInit() leaves alone are cleared here,
+ * BBROnInit() owns the rest, so we skip a memset of the whole slot.
+ */
+static void
+conn_reset(struct conn *c)
+{
+    struct tcp_bbr *BBR = &c->bbr;
+
+    c->cb = (struct tcp_cb){ .state = TCPS_CLOSED };
+
+    BBR->C = &c->cb;
+    BBR->bdp = 0;
+    BBR->bw_probe_wait = 0;
+    BBR->probe_rtt_min_stamp = 0;
+    BBR->bw = 0;
+    BBR->max_bw = 0;
+    BBR->inflight_hi = Infinity;
+    BBR->cycle_stamp = 0;
+    BBR->bw_probe_up_rounds = 0;
+    BBR->bw_probe_up_acks = 0;
+    BBR->probe_up_cnt = 0;
+    BBR->rounds_since_bw_probe = 0;
+    BBR->sub_state = PROBE_BW_DOWN;
+    BBR->ack_phase = ACKS_PROBE_STARTING;
+}
+
+int
+conn_pool_init(struct conn_pool *pool, unsigned int ncpu)
+{
+    unsigned int i;
+
+    if (ncpu == 0 || ncpu > CONN_MAX_CPUS)
+        return (-1);
+
+    pool->ncpu = ncpu;
+    for (i = 0; i < ncpu; i++)
+        pool->cpu[i] = (struct conn_cache){ .carved = CONN_CHUNK_SLOTS };
+    return (0);
+}
+
+void
+conn_pool_destroy(struct conn_pool *pool)
+{
+    struct conn_chunk *ch, *next;
+    unsigned int i;
+
+    for (i = 0; i < pool->ncpu; i++) {
+        for (ch = pool->cpu[i].chunks; ch != NULL; ch = next) {
+            next = ch->next;
+            free(ch);
+        }
+        pool->cpu[i] = (struct conn_cache){ .carved = CONN_CHUNK_SLOTS };
+    }
+}
+
+/*
+ * Take a slot from the cpu's free list, or carve the next one out of its
+ * current chunk. Slots are carved lazily so untouched pages of a fresh
+ * chunk stay unbacked until they are needed.
+ */
+struct conn *
+conn_alloc(struct conn_pool *pool, unsigned int cpu)
+{
+    struct conn_cache *cc = &pool->cpu[cpu];
+    struct conn_chunk *ch;
+    struct conn *c;
+
+    if ((c = cc->free) != NULL) {
+        cc->free = c->next;
+        cc->nfree--;
+    } else {
+        if (cc->carved == CONN_CHUNK_SLOTS) {
+            ch = aligned_alloc(CONN_CACHE_LINE, sizeof(*ch));
+            if (ch == NULL)
+                return (NULL);
+            ch->next = cc->chunks;
+            cc->chunks = ch;
+            cc->carved = 0;
+        }
+        c = &cc->chunks->slots[cc->carved++];
+    }
+    cc->live++;
+    conn_reset(c);
+    return (c);
+}
+
+/*
+ * Return a slot to the freeing cpu's list.
+ * A slot freed on another cpu than it was allocated on simply migrates.
+ */
+void
+conn_free(struct conn_pool *pool, unsigned int cpu, struct conn *c)
+{
+    struct conn_cache *cc = &pool->cpu[cpu];
+
+    c->next = cc->free;
+    cc->free = c;
+    cc->nfree++;
+    cc->live--;
+}
+
+/* Not synchronized with alloc/free, only meaningful once the pool is quiescent */
+uint64_t
+conn_pool_live(struct conn_pool *pool)
+{
+    int64_t live = 0;
+    unsigned int i;
+
+    for (i = 0; i < pool->ncpu; i++)
+        live += pool->cpu[i].live;
+    return (live);
+}
@@ -0,0 +1,51 @@
+#ifndef _CONN_H_
+#define _CONN_H_
+
+#include <stdint.h>
+#include "bbr.h"
+
+#define CONN_CACHE_LINE	64	/* slot and per-cpu cache alignment */
+#define CONN_MAX_CPUS	256	/* upper bound on per-cpu caches in a pool */
+#define CONN_CHUNK_SLOTS	4096	/* slots carved out of each chunk */
+
+/*
+ * Connection state slot.
+ * tcp_cb and tcp_bbr live side by side so that bbr.C never leaves the slot
+ * and a connection touches as few cache lines as possible.
+ */
+struct conn {
+    struct tcp_cb cb;
+    struct tcp_bbr bbr;
+    struct conn *next; /* free list link, only valid while the slot is free */
+} __attribute__((aligned(CONN_CACHE_LINE)));
+
+/* A chunk of slots, allocated from the system and never returned until conn_pool_destroy() */
+struct conn_chunk {
+    struct conn_chunk *next;
+    struct conn slots[CONN_CHUNK_SLOTS];
+};
+
+/*
+ * Per-cpu cache.
+ * Only the owning cpu touches it, so alloc and free take no lock.
+ */
+struct conn_cache {
+    struct conn *free; /* LIFO free list, hot slots first */
+    struct conn_chunk *chunks; /* chunks owned by this cache */
+    uint32_t carved; /* slots already handed out of the newest chunk */
+    uint32_t nfree; /* slots on the free list */
+    int64_t live; /* allocs minus frees on this cpu, negative when slots migrate in */
+} __attribute__((aligned(CONN_CACHE_LINE)));
+
+struct conn_pool {
+    unsigned int ncpu;
+    struct conn_cache cpu[CONN_MAX_CPUS];
+};
+
+extern int conn_pool_init(struct conn_pool *pool, unsigned int ncpu);
+extern void conn_pool_destroy(struct conn_pool *pool);
+extern struct conn *conn_alloc(struct conn_pool *pool, unsigned int cpu);
+extern void conn_free(struct conn_pool *pool, unsigned int cpu, struct conn *c);
+extern uint64_t conn_pool_live(struct conn_pool *pool);
+
+#endif /* _CONN_H_ */
@@ -0,0 +1,159 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "conn.h"
+
+/*
+ * Connection churn benchmark for the conn allocator.
+ *
+ * usage: conn_bench [threads] [opens per thread] [live connections]
+ *
+ * 1. Every thread is pinned to its own cpu and repeatedly closes its oldest
+ *    connection and opens a new one, keeping CHURN_WINDOW connections alive
+ *    so slots are recycled the way short-lived connections recycle them.
+ * 2. Afterwards the main thread opens `live` connections spread over all
+ *    cpu caches and reports RSS growth per connection.
+ */
+
+#define CHURN_WINDOW	64
+
+struct churn_arg {
+    struct conn_pool *pool;
+    unsigned int cache; /* per-cpu cache this thread owns */
+    unsigned int cpu; /* cpu the thread is pinned to */
+    uint64_t opens;
+};
+
+static uint64_t
+NowNsec()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+/* Resident set size in bytes, from /proc/self/statm */
+static long
+rss_bytes()
+{
+    long size, resident;
+    FILE *f;
+
+    if ((f = fopen("/proc/self/statm", "r")) == NULL)
+        return (-1);
+    if (fscanf(f, "%ld %ld", &size, &resident) != 2)
+        resident = -1;
+    fclose(f);
+    return (resident < 0 ? -1 : resident * sysconf(_SC_PAGESIZE));
+}
+
+/* Connection setup: tcp_cb parameters, then BBROnInit() fills in the rest of tcp_bbr */
+static void
+conn_open(struct conn *c)
+{
+    c->cb.smss = 1448;
+    c->cb.rwnd = 65535;
+    c->cb.cwnd = initial_window(&c->cb);
+    c->cb.ssthresh = c->cb.cwnd;
+    c->cb.state = TCPS_ESTABLISHED;
+    BBROnInit(&c->bbr);
+}
+
+static void *
+churn(void *arg)
+{
+    struct churn_arg *a = arg;
+    struct conn *window[CHURN_WINDOW];
+    cpu_set_t set;
+    uint64_t i;
+
+    CPU_ZERO(&set);
+    CPU_SET(a->cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+    for (i = 0; i < CHURN_WINDOW; i++) {
+        if ((window[i] = conn_alloc(a->pool, a->cache)) == NULL)
+            abort();
+        conn_open(window[i]);
+    }
+    for (i = 0; i < a->opens; i++) {
+        struct conn **slot = &window[i % CHURN_WINDOW];
+
+        conn_free(a->pool, a->cache, *slot);
+        if ((*slot = conn_alloc(a->pool, a->cache)) == NULL)
+            abort();
+        conn_open(*slot);
+    }
+    for (i = 0; i < CHURN_WINDOW; i++)
+        conn_free(a->pool, a->cache, window[i]);
+    return (NULL);
+}
+
+int
+main(int argc, char **argv)
+{
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int threads = argc > 1 ? (unsigned int)atoi(argv[1]) : (unsigned int)ncpu;
+    uint64_t opens = argc > 2 ? strtoull(argv[2], NULL, 10) : 10000000;
+    uint64_t live = argc > 3 ? strtoull(argv[3], NULL, 10) : 1000000;
+    static struct conn_pool pool;
+    struct churn_arg *args;
+    pthread_t *tids;
+    struct conn **conns;
+    uint64_t start, elapsed, i;
+    long rss_before, rss_after;
+    unsigned int t;
+
+    if (threads == 0 || threads > CONN_MAX_CPUS || conn_pool_init(&pool, threads) != 0) {
+        fprintf(stderr, "threads must be between 1 and %d\n", CONN_MAX_CPUS);
+        return (1);
+    }
+    printf("slot size %zu bytes, %u threads\n", sizeof(struct conn), threads);
+
+    args = calloc(threads, sizeof(*args));
+    tids = calloc(threads, sizeof(*tids));
+    start = NowNsec();
+    for (t = 0; t < threads; t++) {
+        args[t] = (struct churn_arg){ .pool = &pool, .cache = t, .cpu = t % ncpu, .opens = opens };
+        pthread_create(&tids[t], NULL, churn, &args[t]);
+    }
+    for (t = 0; t < threads; t++)
+        pthread_join(tids[t], NULL);
+    elapsed = NowNsec() - start;
+    printf("churn: %llu open+close in %.3f s, %.0f conn/s\n",
+        (unsigned long long)(opens * threads), elapsed / 1e9,
+        (double)opens * threads * 1e9 / elapsed);
+
+    /* fault in the pointer array first so it does not count against the slots */
+    conns = malloc(live * sizeof(*conns));
+    memset(conns, 0, live * sizeof(*conns));
+    rss_before = rss_bytes();
+    start = NowNsec();
+    for (i = 0; i < live; i++) {
+        if ((conns[i] = conn_alloc(&pool, i % threads)) == NULL) {
+            fprintf(stderr, "out of memory at %llu live connections\n", (unsigned long long)i);
+            return (1);
+        }
+        conn_open(conns[i]);
+    }
+    elapsed = NowNsec() - start;
+    rss_after = rss_bytes();
+    printf("live: %llu connections in %.3f s, rss %.1f MiB (+%.1f MiB, %.0f bytes/conn)\n",
+        (unsigned long long)conn_pool_live(&pool), elapsed / 1e9,
+        rss_after / 1048576.0, (rss_after - rss_before) / 1048576.0,
+        live ? (double)(rss_after - rss_before) / live : 0.0);
+
+    for (i = 0; i < live; i++)
+        conn_free(&pool, i % threads, conns[i]);
+    conn_pool_destroy(&pool);
+    free(conns);
+    free(tids);
+    free(args);
+    return (0);
+}
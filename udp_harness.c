@@ -0,0 +1,868 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <poll.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "conn.h"
+#include "helper.h"
+
+/*
+ * Loopback transport harness.
+ *
+ * usage: udp_harness [-b bytes] [-r bottleneck Mbit/s] [-d round-trip delay usec]
+ *                    [-q bottleneck queue bytes] [-B bucket depth bytes]
+ *
+ * A sender and a receiver thread exchange UDP datagrams over 127.0.0.1.
+ * The sender keeps a tcp_cb/tcp_bbr pair from the conn allocator and only
+ * sends when cwnd has room and the BBR pacing rate allows it, feeding every
+ * ACK back into BBROnACK() as a delivery rate sample.
+ * Losses found by SACK, RACK or RTO go through the cc loss recovery, where
+ * BBR applies packet conservation.
+ * The receiver runs every datagram through a token bucket bottleneck with a
+ * drop-tail queue and a fixed propagation delay before it is "delivered"
+ * and acknowledged with a cumulative ACK and up to LO_MAX_SACK SACK blocks.
+ * The whole round-trip delay is applied on the data path and ACKs return
+ * immediately, so min_rtt is the -d delay.
+ *
+ * Both sides batch with sendmmsg/recvmmsg and the sender uses UDP GSO so
+ * one syscall carries up to LO_GSO_SEGS segments.
+ * Sequence numbers count whole segments of LO_SEG_SIZE bytes, tcp_cb sees
+ * them as bytes so transfers are limited to 4GB.
+ */
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT	103
+#endif
+
+#define LO_SEG_SIZE	1448	/* datagram size, header included */
+#define LO_GSO_SEGS	16	/* segments per GSO send */
+#define LO_BATCH	32	/* messages per sendmmsg/recvmmsg */
+#define LO_WIN_SEGS	(1 << 16)	/* scoreboard and receive window, in segments */
+#define LO_MAX_SACK	3
+#define LO_DUPTHRESH	3
+#define LO_MIN_RTO	(200 * 1000)	/* usec */
+#define LO_SOCKBUF	(8 * 1024 * 1024)
+
+enum lo_type {
+    LO_DATA,
+    LO_ACK,
+    LO_FIN,
+};
+
+struct lo_data_hdr {
+    uint8_t type;
+    uint8_t unused[3];
+    uint32_t seg; /* segment number */
+    uint64_t ts; /* sender timestamp of this transmission, usec */
+};
+
+struct lo_sack_block {
+    uint32_t start; /* first segment of the block */
+    uint32_t end; /* one past the last segment */
+};
+
+struct lo_ack_hdr {
+    uint8_t type;
+    uint8_t nsack;
+    uint8_t unused[2];
+    uint32_t cum; /* next segment expected */
+    uint64_t echo_ts; /* ts of the segment that triggered this ACK */
+    struct lo_sack_block sack[LO_MAX_SACK];
+};
+
+enum lo_seg_state {
+    SEG_SENT,
+    SEG_SACKED,
+    SEG_LOST,
+};
+
+/* Sender scoreboard entry, also the per-packet state of the delivery rate estimator */
+struct lo_seg {
+    uint64_t sent_ts; /* time of the last transmission */
+    uint64_t first_sent_ts; /* sender first_sent_time when sent */
+    uint64_t delivered_ts; /* sender delivered_time when sent */
+    uint32_t delivered; /* C->delivered when sent */
+    uint32_t tx_in_flight; /* C->pipe when sent */
+    uint32_t lost; /* sender lost volume when sent */
+    uint8_t state:2, /* lo_seg_state */
+            retx:1, /* retransmitted since the last RTO */
+            app_limited:1,
+            unused:4;
+};
+
+struct lo_config {
+    uint64_t bytes;
+    uint64_t rate; /* bottleneck, bytes per second */
+    uint32_t rtt; /* round-trip propagation delay, all of it on the data path, usec */
+    uint32_t queue; /* bottleneck queue limit, bytes */
+    uint32_t burst; /* token bucket depth, bytes */
+    struct sockaddr_in addr; /* receiver address */
+};
+
+struct lo_sender_stats {
+    uint64_t segs_sent;
+    uint64_t retransmits;
+    uint64_t unsent_msgs; /* messages sendmmsg() did not take */
+    uint64_t unsent_segs;
+    uint64_t rtos;
+    uint64_t recoveries; /* fast recovery episodes */
+    uint64_t syscalls;
+    uint64_t paced_bursts;
+    uint64_t pacing_err_sum; /* usec the burst left after its schedule */
+    uint64_t pacing_err_max;
+    uint64_t cpu_ns;
+    uint32_t final_cwnd, final_pacing_rate, final_bw, final_min_rtt, final_state;
+};
+
+struct lo_receiver_stats {
+    uint64_t delivered;
+    uint64_t drops;
+    uint64_t syscalls;
+    uint64_t cpu_ns;
+};
+
+struct lo_sender {
+    struct lo_config *cfg;
+    int fd;
+    struct conn *c;
+    struct lo_seg *sb;
+    uint32_t nsegs; /* total segments to transfer */
+    uint32_t una; /* oldest unacknowledged segment */
+    uint32_t next; /* next new segment to send */
+    uint32_t high_sacked; /* one past the highest SACKed segment */
+    uint32_t loss_hint; /* segments below this were already considered for loss marking */
+    uint32_t retx_hint; /* no lost segment below this */
+    uint32_t rack_hint; /* no retransmission still to be checked for loss below this */
+    uint32_t nlost; /* segments currently marked lost and not retransmitted */
+    uint32_t lost; /* total volume ever marked lost */
+    uint32_t lost_ranges; /* total discontiguous ranges ever marked lost */
+    uint32_t last_lost; /* one past the segment marked lost last */
+    uint64_t delivered_ts; /* time of the last delivery */
+    uint64_t rack_ts; /* latest send time among delivered segments (RACK) */
+    uint64_t first_sent_ts; /* send time of the packet that started the current rate sample */
+    uint64_t last_progress; /* RTO timer start, restarted only when una advances (RFC 6298 5.3) */
+    uint64_t next_send; /* pacing schedule */
+    uint8_t gso_ok; /* a GSO message went out, UDP_SEGMENT works */
+    struct lo_sender_stats st;
+};
+
+static uint64_t
+now_usec()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * USECS_IN_SECOND + ts.tv_nsec / 1000);
+}
+
+static uint64_t
+thread_cpu_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+/* Wait until fd is readable or `usec` passed */
+static void
+wait_readable(int fd, uint64_t usec)
+{
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    struct timespec ts = { .tv_sec = usec / USECS_IN_SECOND, .tv_nsec = (usec % USECS_IN_SECOND) * 1000 };
+
+    ppoll(&pfd, 1, &ts, NULL);
+}
+
+static int
+lo_socket()
+{
+    int fd, buf = LO_SOCKBUF;
+
+    if ((fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
+        return (-1);
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(buf));
+    return (fd);
+}
+
+/*
+ * Receiver side.
+ */
+
+struct lo_pkt {
+    uint64_t t; /* arrival at the bottleneck, or delivery time once past it */
+    uint64_t ts; /* sender timestamp to echo */
+    uint32_t seg;
+};
+
+/* FIFO of packets, LO_WIN_SEGS deep, as a ring */
+struct lo_fifo {
+    struct lo_pkt *p;
+    uint32_t head, tail;
+};
+
+static int
+fifo_empty(struct lo_fifo *f) { return (f->head == f->tail); }
+static int
+fifo_full(struct lo_fifo *f) { return (f->tail - f->head == LO_WIN_SEGS); }
+static struct lo_pkt *
+fifo_head(struct lo_fifo *f) { return (&f->p[f->head % LO_WIN_SEGS]); }
+static void
+fifo_push(struct lo_fifo *f, struct lo_pkt *pkt) { f->p[f->tail++ % LO_WIN_SEGS] = *pkt; }
+
+struct lo_receiver {
+    struct lo_config *cfg;
+    int fd;
+    uint8_t *rcvd; /* one flag per segment of the receive window */
+    uint32_t cum;
+    struct lo_sack_block sack[LO_MAX_SACK]; /* most recently reported blocks, newest first */
+    uint8_t nsack;
+    struct lo_fifo bottleneck; /* waiting for tokens */
+    struct lo_fifo wire; /* past the bottleneck, in propagation */
+    uint32_t queued; /* bytes in the bottleneck queue */
+    int64_t tokens; /* token bucket, bytes */
+    uint64_t refill_ts;
+    struct sockaddr_in peer;
+    struct lo_receiver_stats st;
+};
+
+static void
+receiver_refill(struct lo_receiver *R, uint64_t now)
+{
+    uint64_t add = (now - R->refill_ts) * R->cfg->rate / USECS_IN_SECOND;
+
+    if (add == 0)
+        return;
+    R->refill_ts = now;
+    R->tokens += add;
+    if (R->tokens > R->cfg->burst)
+        R->tokens = R->cfg->burst;
+}
+
+/*
+ * Record segment `seg` and build the SACK blocks for its ACK, RFC 2018 style:
+ * the block holding the newest segment first, then the previously reported ones.
+ */
+static void
+receiver_record(struct lo_receiver *R, uint32_t seg)
+{
+    struct lo_sack_block cur, old[LO_MAX_SACK];
+    uint8_t i, n = 0;
+
+    if (seg < R->cum || seg - R->cum >= LO_WIN_SEGS || R->rcvd[seg % LO_WIN_SEGS])
+        return;
+    R->rcvd[seg % LO_WIN_SEGS] = 1;
+    while (R->rcvd[R->cum % LO_WIN_SEGS]) {
+        R->rcvd[R->cum % LO_WIN_SEGS] = 0;
+        R->cum++;
+    }
+    memcpy(old, R->sack, sizeof(old));
+    for (i = 0; i < R->nsack; i++)
+        if (old[i].end > R->cum && old[i].start < R->cum)
+            old[i].start = R->cum;
+    if (seg < R->cum) {
+        cur = (struct lo_sack_block){ 0, 0 };
+    } else if (R->nsack && R->sack[0].end == seg) {
+        /* common case, the newest block grows at its right edge */
+        cur = R->sack[0];
+        cur.end = seg + 1;
+    } else {
+        cur.start = cur.end = seg;
+        while (cur.start > R->cum && R->rcvd[(cur.start - 1) % LO_WIN_SEGS])
+            cur.start--;
+        while (R->rcvd[cur.end % LO_WIN_SEGS] && cur.end - R->cum < LO_WIN_SEGS)
+            cur.end++;
+    }
+    if (cur.end > cur.start)
+        R->sack[n++] = cur;
+    for (i = 0; i < R->nsack && n < LO_MAX_SACK; i++) {
+        if (old[i].end <= R->cum || old[i].end <= old[i].start)
+            continue;
+        if (n && old[i].start <= cur.end && old[i].end >= cur.start)
+            continue;
+        R->sack[n++] = old[i];
+    }
+    R->nsack = n;
+}
+
+static void *
+receiver_run(void *arg)
+{
+    struct lo_receiver *R = arg;
+    static char rbuf[LO_BATCH][LO_SEG_SIZE];
+    static struct lo_ack_hdr abuf[LO_BATCH];
+    struct mmsghdr rmsg[LO_BATCH], amsg[LO_BATCH];
+    struct iovec riov[LO_BATCH], aiov[LO_BATCH];
+    struct sockaddr_in from[LO_BATCH];
+    struct lo_pkt pkt;
+    uint64_t now, wait;
+    int i, n, nacks, done = 0;
+
+    for (i = 0; i < LO_BATCH; i++) {
+        riov[i] = (struct iovec){ .iov_base = rbuf[i], .iov_len = sizeof(rbuf[i]) };
+        aiov[i] = (struct iovec){ .iov_base = &abuf[i], .iov_len = sizeof(abuf[i]) };
+    }
+    R->refill_ts = now_usec();
+    R->tokens = R->cfg->burst;
+
+    while (!done) {
+        for (i = 0; i < LO_BATCH; i++)
+            rmsg[i].msg_hdr = (struct msghdr){ .msg_name = &from[i], .msg_namelen = sizeof(from[i]),
+                                               .msg_iov = &riov[i], .msg_iovlen = 1 };
+        n = recvmmsg(R->fd, rmsg, LO_BATCH, MSG_DONTWAIT, NULL);
+        R->st.syscalls++;
+        now = now_usec();
+        for (i = 0; i < n; i++) {
+            struct lo_data_hdr *h = (struct lo_data_hdr *)rbuf[i];
+
+            if (rmsg[i].msg_len < sizeof(*h))
+                continue;
+            R->peer = from[i];
+            if (h->type == LO_FIN) {
+                done = 1;
+                break;
+            }
+            /* drop tail once the bottleneck queue is full */
+            if (R->queued + LO_SEG_SIZE > R->cfg->queue || fifo_full(&R->bottleneck)) {
+                R->st.drops++;
+                continue;
+            }
+            pkt = (struct lo_pkt){ .t = now, .ts = h->ts, .seg = h->seg };
+            fifo_push(&R->bottleneck, &pkt);
+            R->queued += LO_SEG_SIZE;
+        }
+
+        /* serve the bottleneck queue at the token bucket rate */
+        receiver_refill(R, now);
+        while (!fifo_empty(&R->bottleneck) && R->tokens >= LO_SEG_SIZE && !fifo_full(&R->wire)) {
+            pkt = *fifo_head(&R->bottleneck);
+            R->bottleneck.head++;
+            R->queued -= LO_SEG_SIZE;
+            R->tokens -= LO_SEG_SIZE;
+            pkt.t = now + R->cfg->rtt;
+            fifo_push(&R->wire, &pkt);
+        }
+
+        /* deliver what finished propagating, one ACK per segment */
+        nacks = 0;
+        while (!fifo_empty(&R->wire) && fifo_head(&R->wire)->t <= now && nacks < LO_BATCH) {
+            struct lo_ack_hdr *a = &abuf[nacks];
+
+            pkt = *fifo_head(&R->wire);
+            R->wire.head++;
+            receiver_record(R, pkt.seg);
+            R->st.delivered += LO_SEG_SIZE;
+            *a = (struct lo_ack_hdr){ .type = LO_ACK, .nsack = R->nsack, .cum = R->cum, .echo_ts = pkt.ts };
+            memcpy(a->sack, R->sack, sizeof(a->sack));
+            amsg[nacks].msg_hdr = (struct msghdr){ .msg_name = &R->peer, .msg_namelen = sizeof(R->peer),
+                                                   .msg_iov = &aiov[nacks], .msg_iovlen = 1 };
+            nacks++;
+        }
+        if (nacks) {
+            sendmmsg(R->fd, amsg, nacks, 0);
+            R->st.syscalls++;
+        }
+        if (n > 0 || nacks == LO_BATCH)
+            continue;
+
+        /* sleep until the next packet arrives or the next queued one is due */
+        wait = 1000;
+        if (!fifo_empty(&R->wire))
+            wait = min(wait, fifo_head(&R->wire)->t > now ? fifo_head(&R->wire)->t - now : 0);
+        if (!fifo_empty(&R->bottleneck) && R->tokens < LO_SEG_SIZE)
+            wait = min(wait, (LO_SEG_SIZE - R->tokens) * USECS_IN_SECOND / R->cfg->rate + 1);
+        if (wait)
+            wait_readable(R->fd, wait);
+    }
+    R->st.cpu_ns = thread_cpu_ns();
+    return (NULL);
+}
+
+/*
+ * Sender side.
+ */
+
+/* Account one newly delivered segment into the rate sample, per the delivery rate estimation draft */
+static void
+sender_deliver(struct lo_sender *S, uint32_t seg, uint64_t now, struct bbr_rate_sample *rs,
+               uint64_t *prior_ts, uint64_t *send_elapsed)
+{
+    struct lo_seg *p = &S->sb[seg % LO_WIN_SEGS];
+    struct tcp_cb *C = &S->c->cb;
+
+    if (p->state == SEG_SENT)
+        C->pipe -= LO_SEG_SIZE;
+    else if (p->state == SEG_LOST)
+        S->nlost--;
+    p->state = SEG_SACKED;
+    if (p->sent_ts > S->rack_ts)
+        S->rack_ts = p->sent_ts;
+    C->delivered += LO_SEG_SIZE;
+    S->delivered_ts = now;
+    rs->newly_acked += LO_SEG_SIZE;
+    if (p->delivered >= rs->prior_delivered) {
+        rs->prior_delivered = p->delivered;
+        rs->tx_in_flight = p->tx_in_flight;
+        rs->lost = S->lost - p->lost;
+        rs->is_app_limited = p->app_limited;
+        *prior_ts = p->delivered_ts;
+        *send_elapsed = p->sent_ts - p->first_sent_ts;
+        S->first_sent_ts = p->sent_ts;
+    }
+}
+
+static void
+sender_mark_lost(struct lo_sender *S, uint32_t seg)
+{
+    struct lo_seg *p = &S->sb[seg % LO_WIN_SEGS];
+
+    if (p->state != SEG_SENT)
+        return;
+    p->state = SEG_LOST;
+    p->retx = 0;
+    S->c->cb.pipe -= LO_SEG_SIZE;
+    S->lost += LO_SEG_SIZE;
+    S->nlost++;
+    if (seg != S->last_lost)
+        S->lost_ranges++;
+    S->last_lost = seg + 1;
+    if (seg < S->retx_hint)
+        S->retx_hint = seg;
+}
+
+static void
+sender_on_ack(struct lo_sender *S, const struct lo_ack_hdr *a)
+{
+    struct tcp_cb *C = &S->c->cb;
+    struct bbr_rate_sample rs = { 0 };
+    uint64_t now = now_usec(), prior_ts = 0, send_elapsed = 0, ack_elapsed, interval;
+    struct lo_seg *p;
+    uint32_t s, acked, newly = 0, lost = S->lost, lost_ranges = S->lost_ranges, recover;
+    int i, valid = 0;
+
+    if (a->cum > S->next)
+        return;
+    for (s = S->una; s < a->cum; s++) {
+        if (S->sb[s % LO_WIN_SEGS].state != SEG_SACKED) {
+            sender_deliver(S, s, now, &rs, &prior_ts, &send_elapsed);
+            valid = 1;
+        }
+    }
+    acked = rs.newly_acked;
+    if (a->cum > S->una) {
+        S->una = a->cum;
+        S->last_progress = now;
+    }
+    /*
+     * Walk every block in full: a retransmission filling a hole merges two
+     * blocks whose edges are both already SACKed. The range is bounded by LO_WIN_SEGS.
+     */
+    for (i = 0; i < a->nsack && i < LO_MAX_SACK; i++) {
+        uint32_t start = max(a->sack[i].start, S->una), end = min(a->sack[i].end, S->next);
+
+        for (s = start; s < end; s++) {
+            if (S->sb[s % LO_WIN_SEGS].state != SEG_SACKED) {
+                sender_deliver(S, s, now, &rs, &prior_ts, &send_elapsed);
+                newly++;
+            }
+        }
+        S->high_sacked = max(S->high_sacked, end);
+    }
+    if (newly)
+        valid = 1;
+    S->loss_hint = max(S->loss_hint, S->una);
+    S->retx_hint = max(S->retx_hint, S->una);
+
+    /* a segment is lost once LO_DUPTHRESH later segments were SACKed */
+    for (; S->loss_hint + LO_DUPTHRESH < S->high_sacked; S->loss_hint++)
+        if (!S->sb[S->loss_hint % LO_WIN_SEGS].retx)
+            sender_mark_lost(S, S->loss_hint);
+
+    /*
+     * Retransmissions are left to RACK: one is lost once a segment sent more
+     * than a reordering window (SRTT/4) after it was delivered. They go out in
+     * sequence order, so the walk stops at the first one still in time.
+     */
+    for (S->rack_hint = max(S->rack_hint, S->una); S->rack_hint < S->next; S->rack_hint++) {
+        p = &S->sb[S->rack_hint % LO_WIN_SEGS];
+        if (p->state != SEG_SENT || !p->retx)
+            continue;
+        if (p->sent_ts + C->SRTT / 4 >= S->rack_ts)
+            break;
+        sender_mark_lost(S, S->rack_hint);
+    }
+
+    if (now > a->echo_ts) {
+        rs.rtt = now - a->echo_ts;
+        C->SRTT = C->SRTT ? (7 * C->SRTT + rs.rtt) / 8 : rs.rtt;
+    }
+    C->snd_una = S->una * LO_SEG_SIZE;
+    rs.newly_lost = S->lost - lost;
+    rs.newly_lost_ranges = S->lost_ranges - lost_ranges;
+    if (S->lost != lost) {
+        recover = C->recover;
+        cc_cong_signal(C, CC_NDUPACK);
+        S->st.recoveries += C->recover != recover;
+    }
+    cc_ack_received(C, acked, rs.newly_acked - acked);
+    if (!valid)
+        return;
+
+    rs.delivered = C->delivered - rs.prior_delivered;
+    ack_elapsed = S->delivered_ts - prior_ts;
+    interval = max(send_elapsed, ack_elapsed);
+    if (interval && prior_ts)
+        rs.delivery_rate = (uint64_t)rs.delivered * USECS_IN_SECOND / interval;
+    else
+        rs.is_app_limited = 1; /* no usable bw sample, keep it out of the max filter */
+    BBROnACK(&S->c->bbr, &rs);
+}
+
+/*
+ * Every outstanding segment is presumed lost once nothing was acked
+ * cumulatively for an RTO. This also bounds a fast recovery that stops
+ * making progress, SACKs alone never push the timer out.
+ */
+static void
+sender_check_rto(struct lo_sender *S, uint64_t now)
+{
+    struct tcp_cb *C = &S->c->cb;
+    uint64_t rto = (uint64_t)max(LO_MIN_RTO, 4 * C->SRTT) << min(C->rxtshift, 6);
+    uint32_t s;
+
+    if (S->una == S->next || now - S->last_progress < rto)
+        return;
+    for (s = S->una; s < S->next; s++) {
+        S->sb[s % LO_WIN_SEGS].retx = 0;
+        sender_mark_lost(S, s);
+    }
+    S->loss_hint = S->una;
+    S->last_progress = now;
+    cc_cong_signal(C, CC_RTO);
+    S->st.rtos++;
+}
+
+/* Next segment to send, retransmissions first; returns false when there is nothing to send */
+static int
+sender_next_seg(struct lo_sender *S, uint32_t *seg)
+{
+    if (S->nlost) {
+        while (S->retx_hint < S->next && S->sb[S->retx_hint % LO_WIN_SEGS].state != SEG_LOST)
+            S->retx_hint++;
+        if (S->retx_hint < S->next) {
+            *seg = S->retx_hint;
+            return (true);
+        }
+    }
+    if (S->next < S->nsegs && S->next - S->una < LO_WIN_SEGS) {
+        *seg = S->next;
+        return (true);
+    }
+    return (false);
+}
+
+static void
+sender_record_send(struct lo_sender *S, uint32_t seg, uint64_t now)
+{
+    struct lo_seg *p = &S->sb[seg % LO_WIN_SEGS];
+    struct tcp_cb *C = &S->c->cb;
+    uint8_t retx = seg != S->next;
+
+    /* RFC 6298 5.1, start the RTO timer when data goes out with nothing outstanding */
+    if (S->una == S->next)
+        S->last_progress = now;
+    if (C->pipe == 0) {
+        /* first packet of a flight, restart the send interval */
+        S->first_sent_ts = now;
+        S->delivered_ts = now;
+    }
+    if (retx) {
+        S->nlost--;
+        if (seg < S->rack_hint)
+            S->rack_hint = seg;
+        S->st.retransmits++;
+    } else {
+        S->next++;
+        C->snd_max = S->next * LO_SEG_SIZE;
+    }
+    *p = (struct lo_seg){ .sent_ts = now, .first_sent_ts = S->first_sent_ts, .delivered_ts = S->delivered_ts,
+                          .delivered = C->delivered, .tx_in_flight = C->pipe + LO_SEG_SIZE, .lost = S->lost,
+                          .state = SEG_SENT, .retx = retx, .app_limited = C->app_limited };
+    C->pipe += LO_SEG_SIZE;
+    cc_on_transmit(C, LO_SEG_SIZE);
+    S->st.segs_sent++;
+}
+
+/*
+ * Segments of messages sendmmsg() did not take never left the host.
+ * They are taken back out of the send counters and marked lost so that
+ * they are retransmitted right away, but are kept out of the loss volume BBR sees.
+ */
+static void
+sender_unsent(struct lo_sender *S, struct iovec *iov, int from, int to)
+{
+    struct lo_data_hdr *h;
+    uint32_t k;
+    int m;
+
+    for (m = from; m < to; m++) {
+        for (k = 0; k < iov[m].iov_len / LO_SEG_SIZE; k++) {
+            h = (struct lo_data_hdr *)((char *)iov[m].iov_base + k * LO_SEG_SIZE);
+            if (S->sb[h->seg % LO_WIN_SEGS].retx)
+                S->st.retransmits--;
+            sender_mark_lost(S, h->seg);
+            S->lost -= LO_SEG_SIZE; /* not a congestion signal */
+            S->st.segs_sent--;
+            S->st.unsent_segs++;
+        }
+        S->st.paced_bursts--;
+        S->st.unsent_msgs++;
+    }
+}
+
+/*
+ * Send as many pacing quanta as are due and fit in cwnd, one GSO message
+ * per quantum, all of them in a single sendmmsg().
+ */
+static void
+sender_transmit(struct lo_sender *S, uint64_t now)
+{
+    static char buf[LO_BATCH][LO_GSO_SEGS * LO_SEG_SIZE];
+    static char cbuf[LO_BATCH][CMSG_SPACE(sizeof(uint16_t))];
+    struct mmsghdr msg[LO_BATCH];
+    struct iovec iov[LO_BATCH];
+    struct tcp_cb *C = &S->c->cb;
+    struct tcp_bbr *BBR = &S->c->bbr;
+    uint32_t quantum, seg, rate;
+    int m, k, sent, gso = -1;
+
+    /* about 1ms worth of data per burst, like TSO autosizing */
+    rate = max(BBR->pacing_rate, LO_SEG_SIZE);
+    quantum = min(max(rate / 1000 / LO_SEG_SIZE, 1), LO_GSO_SEGS);
+    /* idle time does not bank pacing credit beyond one quantum */
+    if (S->next_send + (uint64_t)quantum * LO_SEG_SIZE * USECS_IN_SECOND / rate < now)
+        S->next_send = now;
+
+    C->app_limited = !S->nlost && S->next == S->nsegs;
+    BBROnTransmit(BBR);
+
+    for (m = 0; m < LO_BATCH && S->next_send <= now; m++) {
+        struct cmsghdr *cm;
+
+        for (k = 0; k < (int)quantum && C->pipe + LO_SEG_SIZE <= C->cwnd && sender_next_seg(S, &seg); k++) {
+            struct lo_data_hdr *h = (struct lo_data_hdr *)&buf[m][k * LO_SEG_SIZE];
+
+            *h = (struct lo_data_hdr){ .type = LO_DATA, .seg = seg, .ts = now };
+            sender_record_send(S, seg, now);
+        }
+        if (k == 0)
+            break;
+        if (S->next_send < now) {
+            S->st.pacing_err_sum += now - S->next_send;
+            S->st.pacing_err_max = max(S->st.pacing_err_max, now - S->next_send);
+        }
+        S->st.paced_bursts++;
+        S->next_send += (uint64_t)k * LO_SEG_SIZE * USECS_IN_SECOND / rate;
+
+        iov[m] = (struct iovec){ .iov_base = buf[m], .iov_len = k * LO_SEG_SIZE };
+        msg[m].msg_hdr = (struct msghdr){ .msg_iov = &iov[m], .msg_iovlen = 1 };
+        if (k > 1) {
+            if (gso < 0)
+                gso = m;
+            msg[m].msg_hdr.msg_control = cbuf[m];
+            msg[m].msg_hdr.msg_controllen = sizeof(cbuf[m]);
+            cm = CMSG_FIRSTHDR(&msg[m].msg_hdr);
+            cm->cmsg_level = SOL_UDP;
+            cm->cmsg_type = UDP_SEGMENT;
+            cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            *(uint16_t *)CMSG_DATA(cm) = LO_SEG_SIZE;
+        }
+    }
+    if (m == 0)
+        return;
+    sent = sendmmsg(S->fd, msg, m, 0);
+    S->st.syscalls++;
+    if (!S->gso_ok && gso >= 0) {
+        /* without UDP_SEGMENT every number the harness reports would be wrong */
+        if (sent <= gso) {
+            fprintf(stderr, "udp_harness: first UDP_SEGMENT send failed: %s\n",
+                sent < 0 ? strerror(errno) : "message not taken");
+            exit(1);
+        }
+        S->gso_ok = 1;
+    }
+    if (sent < m)
+        sender_unsent(S, iov, sent < 0 ? 0 : sent, m);
+}
+
+static void *
+sender_run(void *arg)
+{
+    struct lo_sender *S = arg;
+    static struct lo_ack_hdr abuf[LO_BATCH];
+    struct mmsghdr amsg[LO_BATCH];
+    struct iovec aiov[LO_BATCH];
+    struct lo_data_hdr fin = { .type = LO_FIN };
+    struct tcp_cb *C = &S->c->cb;
+    uint64_t now;
+    int i, n;
+
+    for (i = 0; i < LO_BATCH; i++)
+        aiov[i] = (struct iovec){ .iov_base = &abuf[i], .iov_len = sizeof(abuf[i]) };
+    S->last_progress = S->next_send = now_usec();
+
+    while (S->una < S->nsegs) {
+        for (i = 0; i < LO_BATCH; i++)
+            amsg[i].msg_hdr = (struct msghdr){ .msg_iov = &aiov[i], .msg_iovlen = 1 };
+        n = recvmmsg(S->fd, amsg, LO_BATCH, MSG_DONTWAIT, NULL);
+        S->st.syscalls++;
+        for (i = 0; i < n; i++)
+            if (amsg[i].msg_len >= offsetof(struct lo_ack_hdr, sack) && abuf[i].type == LO_ACK)
+                sender_on_ack(S, &abuf[i]);
+
+        now = now_usec();
+        sender_check_rto(S, now);
+        if (S->next_send <= now && C->pipe + LO_SEG_SIZE <= C->cwnd)
+            sender_transmit(S, now);
+        if (n > 0)
+            continue;
+
+        now = now_usec();
+        if (S->next_send > now && C->pipe + LO_SEG_SIZE <= C->cwnd)
+            wait_readable(S->fd, S->next_send - now);
+        else
+            wait_readable(S->fd, 1000);
+    }
+    for (i = 0; i < 3; i++)
+        send(S->fd, &fin, sizeof(fin), 0);
+
+    S->st.cpu_ns = thread_cpu_ns();
+    S->st.final_cwnd = C->cwnd;
+    S->st.final_pacing_rate = S->c->bbr.pacing_rate;
+    S->st.final_bw = S->c->bbr.bw;
+    S->st.final_min_rtt = S->c->bbr.min_rtt;
+    S->st.final_state = S->c->bbr.state;
+    return (NULL);
+}
+
+static void
+usage()
+{
+    fprintf(stderr, "usage: udp_harness [-b bytes] [-r Mbit/s] [-d rtt usec] [-q queue bytes] [-B burst bytes]\n");
+    exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+    static const char *states[] = { "STARTUP", "DRAIN", "PROBE_BW", "PROBE_RTT" };
+    struct lo_config cfg = { .bytes = 1ULL << 30, .rate = 1000ULL * 1000 * 1000 / 8, .rtt = 5000 };
+    struct lo_receiver R = { .cfg = &cfg };
+    struct lo_sender S = { .cfg = &cfg };
+    struct conn_pool *pool;
+    socklen_t alen = sizeof(cfg.addr);
+    pthread_t rt, st;
+    uint64_t start, wall;
+    double gbit, cpu;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:r:d:q:B:")) != -1) {
+        switch (opt) {
+        case 'b': cfg.bytes = strtoull(optarg, NULL, 10); break;
+        case 'r': cfg.rate = strtoull(optarg, NULL, 10) * 1000 * 1000 / 8; break;
+        case 'd': cfg.rtt = strtoul(optarg, NULL, 10); break;
+        case 'q': cfg.queue = strtoul(optarg, NULL, 10); break;
+        case 'B': cfg.burst = strtoul(optarg, NULL, 10); break;
+        default: usage();
+        }
+    }
+    if (cfg.bytes == 0 || cfg.bytes >= UINT32_MAX - LO_SEG_SIZE || cfg.rate == 0)
+        usage();
+    /* default to a BDP worth of queue and a bucket of 1ms or 10 packets, whichever is larger */
+    if (cfg.queue == 0)
+        cfg.queue = max(cfg.rate * cfg.rtt / USECS_IN_SECOND, 64 * LO_SEG_SIZE);
+    if (cfg.burst == 0)
+        cfg.burst = max(cfg.rate / 1000, 10 * LO_SEG_SIZE);
+
+    if ((R.fd = lo_socket()) < 0 || (S.fd = lo_socket()) < 0) {
+        perror("socket");
+        return (1);
+    }
+    cfg.addr = (struct sockaddr_in){ .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    if (bind(R.fd, (struct sockaddr *)&cfg.addr, sizeof(cfg.addr)) < 0 ||
+        getsockname(R.fd, (struct sockaddr *)&cfg.addr, &alen) < 0 ||
+        connect(S.fd, (struct sockaddr *)&cfg.addr, sizeof(cfg.addr)) < 0) {
+        perror("bind/connect");
+        return (1);
+    }
+
+    R.rcvd = calloc(LO_WIN_SEGS, sizeof(*R.rcvd));
+    R.bottleneck.p = calloc(LO_WIN_SEGS, sizeof(struct lo_pkt));
+    R.wire.p = calloc(LO_WIN_SEGS, sizeof(struct lo_pkt));
+    S.sb = calloc(LO_WIN_SEGS, sizeof(*S.sb));
+    pool = calloc(1, sizeof(*pool));
+    if (!R.rcvd || !R.bottleneck.p || !R.wire.p || !S.sb || !pool || conn_pool_init(pool, 1) != 0 ||
+        (S.c = conn_alloc(pool, 0)) == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return (1);
+    }
+    S.nsegs = (cfg.bytes + LO_SEG_SIZE - 1) / LO_SEG_SIZE;
+    S.c->cb.smss = LO_SEG_SIZE;
+    S.c->cb.rwnd = LO_WIN_SEGS * LO_SEG_SIZE;
+    S.c->cb.cwnd = initial_window(&S.c->cb);
+    S.c->cb.ssthresh = UINT32_MAX;
+    S.c->cb.state = TCPS_ESTABLISHED;
+    BBROnInit(&S.c->bbr);
+
+    printf("bottleneck %.1f Mbit/s, rtt %u us, queue %u bytes, bucket %u bytes, %llu bytes\n",
+        cfg.rate * 8 / 1e6, cfg.rtt, cfg.queue, cfg.burst, (unsigned long long)cfg.bytes);
+    start = now_usec();
+    pthread_create(&rt, NULL, receiver_run, &R);
+    pthread_create(&st, NULL, sender_run, &S);
+    pthread_join(st, NULL);
+    wall = now_usec() - start;
+    pthread_join(rt, NULL);
+
+    gbit = (double)S.nsegs * LO_SEG_SIZE * 8 / 1e9;
+    cpu = (S.st.cpu_ns + R.st.cpu_ns) / 1e9;
+    printf("throughput: %.3f Gbit/s over %.3f s (bottleneck %.3f Gbit/s)\n",
+        gbit * USECS_IN_SECOND / wall, wall / 1e6, cfg.rate * 8 / 1e9);
+    printf("cpu: sender %.3f s, receiver %.3f s, %.3f cpu-s/Gbit\n",
+        S.st.cpu_ns / 1e9, R.st.cpu_ns / 1e9, cpu / gbit);
+    printf("syscalls: sender %llu, receiver %llu\n",
+        (unsigned long long)S.st.syscalls, (unsigned long long)R.st.syscalls);
+    printf("segments: %llu sent, %llu retransmitted, %llu dropped at bottleneck, %llu recoveries, %llu rto\n",
+        (unsigned long long)S.st.segs_sent, (unsigned long long)S.st.retransmits,
+        (unsigned long long)R.st.drops, (unsigned long long)S.st.recoveries, (unsigned long long)S.st.rtos);
+    if (S.st.unsent_msgs)
+        printf("unsent: %llu messages, %llu segments not taken by sendmmsg()\n",
+            (unsigned long long)S.st.unsent_msgs, (unsigned long long)S.st.unsent_segs);
+    printf("pacing: %llu bursts, mean lateness %.1f us, max %llu us\n",
+        (unsigned long long)S.st.paced_bursts,
+        S.st.paced_bursts ? (double)S.st.pacing_err_sum / S.st.paced_bursts : 0.0,
+        (unsigned long long)S.st.pacing_err_max);
+    printf("bbr: state %s, bw %.1f Mbit/s, pacing %.1f Mbit/s, min_rtt %u us, cwnd %u bytes\n",
+        states[S.st.final_state], S.st.final_bw * 8 / 1e6, S.st.final_pacing_rate * 8 / 1e6,
+        S.st.final_min_rtt, S.st.final_cwnd);
+
+    conn_free(pool, 0, S.c);
+    conn_pool_destroy(pool);
+    free(pool);
+    free(S.sb);
+    free(R.wire.p);
+    free(R.bottleneck.p);
+    free(R.rcvd);
+    close(S.fd);
+    close(R.fd);
+    return (0);
+}